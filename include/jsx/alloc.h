@@ -0,0 +1,101 @@
+//
+//  jsx/alloc.h
+//  https://github.com/jonpalmisc/jsx
+//
+//  Copyright (c) 2022-2023 Jon Palmisciano. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright
+//     notice, this list of conditions and the following disclaimer in the
+//     documentation and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <jsx/timer.h>
+
+#include <cstdint>
+#include <functional>
+
+namespace jsx {
+
+/// Heap allocation counters.
+///
+/// Counters are only maintained once this library is linked in, as it replaces
+/// the global `operator new` and `operator delete`. Over-aligned allocations
+/// are not tracked.
+struct AllocStats {
+    /// Number of allocations made.
+    uint64_t allocations = 0;
+
+    /// Number of deallocations made.
+    uint64_t deallocations = 0;
+
+    /// Total number of bytes allocated.
+    uint64_t bytes = 0;
+
+    /// Highest number of bytes live at once.
+    uint64_t peak_bytes = 0;
+};
+
+/// Get the allocation counters for the calling thread.
+///
+/// Memory freed by a thread other than the one which allocated it is counted
+/// against the freeing thread.
+[[nodiscard]] AllocStats alloc_stats();
+
+/// Scope-based tracker for measuring allocations made on the current thread.
+///
+/// Starts counting as soon as it is initialized (enters scope) and reports the
+/// allocations made and the elapsed time when it falls out of scope. The peak
+/// is reported relative to the number of bytes live upon entering scope.
+class ScopedAllocTracker : public Timer {
+    using AllocCallbackMs = std::function<void(AllocStats const &stats,
+        uint64_t elapsed_ms)>;
+
+    AllocStats *m_stats_out;
+    AllocCallbackMs m_on_destroy_callback;
+
+    AllocStats m_start_stats;
+    int64_t m_start_live_bytes;
+    int64_t m_outer_peak_bytes;
+
+    void begin();
+
+public:
+    /// Create a new tracker which writes the allocations made to \p stats_out
+    /// upon falling out of scope.
+    explicit ScopedAllocTracker(AllocStats *stats_out);
+
+    /// Create a new tracker which runs the provided \p on_destroy callback
+    /// (with the allocations made and elapsed time as parameters) upon falling
+    /// out of scope.
+    explicit ScopedAllocTracker(AllocCallbackMs on_destroy);
+    ~ScopedAllocTracker();
+
+    ScopedAllocTracker(ScopedAllocTracker const &) = delete;
+    ScopedAllocTracker &operator=(ScopedAllocTracker const &) = delete;
+};
+
+}
@@ -34,6 +34,8 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
+#include <functional>
 #include <string>
 
 namespace jsx {
@@ -83,4 +85,62 @@ public:
     ~ScopedTimer();
 };
 
+namespace detail {
+struct DeadlineEntry;
+}
+
+/// Events reported by a deadline timer.
+enum class DeadlineEvent {
+    /// The scope is still running but has exceeded its budget.
+    Overrun,
+
+    /// The scope has ended after previously exceeding its budget.
+    Finished,
+};
+
+/// Scope-based timer with a latency budget.
+///
+/// Registers itself with a shared background watchdog thread upon entering
+/// scope. If the scope is still running once its budget has elapsed, the
+/// watchdog reports the overrun while the scope is still executing; the final
+/// duration of the scope is then reported again when it falls out of scope.
+/// Scopes which finish within their budget report nothing; scopes which
+/// overrun by less than the watchdog's granularity (a few milliseconds) only
+/// report the finished event.
+///
+/// Registration and unregistration never take a lock. Entries are pooled, so
+/// allocations are only needed while more registrations are outstanding than
+/// before, counting those made within the last few milliseconds. While no
+/// timers are alive the watchdog sleeps, and the first registration afterward
+/// wakes it with a system call. Deadlines follow the steady clock.
+class DeadlineTimer : public Timer {
+    using DeadlineCallbackMs = std::function<void(DeadlineEvent event,
+        uint64_t elapsed_ms)>;
+
+    detail::DeadlineEntry *m_entry;
+
+public:
+    /// Create a new deadline timer which logs a warning (identifying the scope
+    /// by \p name) if it is still running after \p budget_ms milliseconds.
+    ///
+    /// The name is not copied and must outlive the timer.
+    DeadlineTimer(char const *name, uint64_t budget_ms);
+
+    /// Create a new deadline timer which runs the provided \p on_event
+    /// callback if it is still running after \p budget_ms milliseconds.
+    ///
+    /// Overrun events are reported from the watchdog thread. Finished events
+    /// are reported from the thread which owns the timer, unless the scope
+    /// ends while the overrun is still being reported; the timer never waits
+    /// for the callback, and the watchdog reports the finished event itself
+    /// once the overrun callback returns.
+    ///
+    /// An empty callback logs a warning for an unnamed scope instead.
+    DeadlineTimer(uint64_t budget_ms, DeadlineCallbackMs on_event);
+    ~DeadlineTimer();
+
+    DeadlineTimer(DeadlineTimer const &) = delete;
+    DeadlineTimer &operator=(DeadlineTimer const &) = delete;
+};
+
 }
@@ -0,0 +1,237 @@
+//
+//  jsx/alloc.cpp
+//  https://github.com/jonpalmisc/jsx
+//
+//  Copyright (c) 2022-2023 Jon Palmisciano. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright
+//     notice, this list of conditions and the following disclaimer in the
+//     documentation and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//  POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <jsx/alloc.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace jsx {
+
+/// Per-thread allocation counters.
+///
+/// Must remain trivial so that it is usable from within `operator new` before
+/// any other initialization has happened on the thread.
+struct AllocCounters {
+    uint64_t allocations;
+    uint64_t deallocations;
+    uint64_t bytes;
+    int64_t live_bytes;
+    int64_t peak_bytes;
+
+    /// Peak live size since the innermost active tracker started; kept apart
+    /// from `peak_bytes` so that the thread's peak is never disturbed.
+    int64_t scope_peak_bytes;
+};
+
+static thread_local AllocCounters t_counters;
+
+/// Size of the header placed before each allocation to record its size;
+/// preserves the alignment guaranteed by `malloc`.
+constexpr size_t ALLOC_HEADER_SIZE = alignof(std::max_align_t);
+
+static void *tracked_malloc(size_t size)
+{
+    // Requests too large to fit the header must fail rather than wrap around.
+    if (size > SIZE_MAX - ALLOC_HEADER_SIZE)
+        return nullptr;
+
+    auto base = static_cast<unsigned char *>(std::malloc(ALLOC_HEADER_SIZE + size));
+    if (!base)
+        return nullptr;
+
+    *reinterpret_cast<size_t *>(base) = size;
+
+    auto &counters = t_counters;
+    ++counters.allocations;
+    counters.bytes += size;
+    counters.live_bytes += static_cast<int64_t>(size);
+    counters.peak_bytes = std::max(counters.peak_bytes, counters.live_bytes);
+    counters.scope_peak_bytes = std::max(counters.scope_peak_bytes, counters.live_bytes);
+
+    return base + ALLOC_HEADER_SIZE;
+}
+
+static void tracked_free(void *ptr)
+{
+    if (!ptr)
+        return;
+
+    auto base = static_cast<unsigned char *>(ptr) - ALLOC_HEADER_SIZE;
+
+    auto &counters = t_counters;
+    ++counters.deallocations;
+    counters.live_bytes -= static_cast<int64_t>(*reinterpret_cast<size_t *>(base));
+
+    std::free(base);
+}
+
+static void *tracked_new(size_t size)
+{
+    for (;;) {
+        if (auto ptr = tracked_malloc(size))
+            return ptr;
+
+        // Follow the standard allocation failure protocol: keep retrying for as
+        // long as there is a handler which may be able to free memory.
+        auto handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+
+        handler();
+    }
+}
+
+static void *tracked_new_nothrow(size_t size) noexcept
+{
+    try {
+        return tracked_new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+AllocStats alloc_stats()
+{
+    auto const &counters = t_counters;
+
+    AllocStats stats;
+    stats.allocations = counters.allocations;
+    stats.deallocations = counters.deallocations;
+    stats.bytes = counters.bytes;
+    stats.peak_bytes = static_cast<uint64_t>(std::max<int64_t>(counters.peak_bytes, 0));
+    return stats;
+}
+
+ScopedAllocTracker::ScopedAllocTracker(AllocStats *stats_out)
+    : m_stats_out(stats_out)
+    , m_on_destroy_callback(nullptr)
+{
+    begin();
+}
+
+ScopedAllocTracker::ScopedAllocTracker(AllocCallbackMs on_destroy)
+    : m_stats_out(nullptr)
+    , m_on_destroy_callback(std::move(on_destroy))
+{
+    begin();
+}
+
+void ScopedAllocTracker::begin()
+{
+    auto &counters = t_counters;
+
+    // Restart the scope peak at the current live size so the scope's own
+    // peak can be measured; the outer scope's peak is restored when it ends.
+    m_start_stats = alloc_stats();
+    m_start_live_bytes = counters.live_bytes;
+    m_outer_peak_bytes = counters.scope_peak_bytes;
+    counters.scope_peak_bytes = counters.live_bytes;
+
+    reset();
+}
+
+ScopedAllocTracker::~ScopedAllocTracker()
+{
+    auto elapsed = elapsed_ms();
+    auto &counters = t_counters;
+
+    AllocStats stats;
+    stats.allocations = counters.allocations - m_start_stats.allocations;
+    stats.deallocations = counters.deallocations - m_start_stats.deallocations;
+    stats.bytes = counters.bytes - m_start_stats.bytes;
+    stats.peak_bytes = static_cast<uint64_t>(counters.scope_peak_bytes - m_start_live_bytes);
+
+    counters.scope_peak_bytes = std::max(counters.scope_peak_bytes, m_outer_peak_bytes);
+
+    if (m_on_destroy_callback) {
+        m_on_destroy_callback(stats, elapsed);
+    } else if (m_stats_out) {
+        *m_stats_out = stats;
+    }
+}
+
+}
+
+void *operator new(std::size_t size)
+{
+    return jsx::tracked_new(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return jsx::tracked_new(size);
+}
+
+void *operator new(std::size_t size, std::nothrow_t const &) noexcept
+{
+    return jsx::tracked_new_nothrow(size);
+}
+
+void *operator new[](std::size_t size, std::nothrow_t const &) noexcept
+{
+    return jsx::tracked_new_nothrow(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    jsx::tracked_free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    jsx::tracked_free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    jsx::tracked_free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    jsx::tracked_free(ptr);
+}
+
+void operator delete(void *ptr, std::nothrow_t const &) noexcept
+{
+    jsx::tracked_free(ptr);
+}
+
+void operator delete[](void *ptr, std::nothrow_t const &) noexcept
+{
+    jsx::tracked_free(ptr);
+}
@@ -36,6 +36,7 @@
 #include <cstdarg>
 #include <cstdio>
 #include <unordered_map>
+#include <vector>
 
 namespace jsx {
 
@@ -64,45 +65,54 @@ constexpr auto ANSI_FG_YELLOW = "\x1b[33m";
 constexpr auto ANSI_FG_BLUE = "\x1b[34m";
 constexpr auto ANSI_FG_RESET = "\x1b[0m";
 
-void set_log_color(FILE *stream, LogLevel level)
+char const *log_color(LogLevel level)
 {
     if (!g_log_config.use_color)
-        return;
+        return "";
 
     switch (level) {
     case LogLevel::Error:
-        std::fprintf(stream, ANSI_FG_RED);
-        break;
+        return ANSI_FG_RED;
     case LogLevel::Warning:
-        std::fprintf(stream, ANSI_FG_YELLOW);
-        break;
+        return ANSI_FG_YELLOW;
     case LogLevel::Debug:
-        std::fprintf(stream, ANSI_FG_GREEN);
-        break;
+        return ANSI_FG_GREEN;
     case LogLevel::Trace:
-        std::fprintf(stream, ANSI_FG_BLUE);
-        break;
+        return ANSI_FG_BLUE;
     default:
-        break;
+        return "";
     }
 }
 
-void clear_log_color(FILE *stream)
+char const *log_color_reset()
 {
-    if (!g_log_config.use_color)
-        return;
-
-    std::fprintf(stream, ANSI_FG_RESET);
+    return g_log_config.use_color ? ANSI_FG_RESET : "";
 }
 
 void log_internal(LogLevel level, char const *format, va_list args)
 {
     auto stream = level == LogLevel::Error ? stderr : stdout;
 
-    set_log_color(stream, level);
-    std::vfprintf(stream, format, args);
-    clear_log_color(stream);
-    std::fprintf(stream, "\n");
+    // Format the message up front so that it can be written with a single
+    // call; otherwise messages logged from other threads (e.g. the deadline
+    // watchdog) may interleave with it.
+    char buffer[512];
+    std::va_list args_copy;
+    va_copy(args_copy, args);
+    auto length = std::vsnprintf(buffer, sizeof(buffer), format, args_copy);
+    va_end(args_copy);
+    if (length < 0)
+        return;
+
+    auto message = buffer;
+    std::vector<char> long_buffer;
+    if (static_cast<size_t>(length) >= sizeof(buffer)) {
+        long_buffer.resize(static_cast<size_t>(length) + 1);
+        std::vsnprintf(long_buffer.data(), long_buffer.size(), format, args);
+        message = long_buffer.data();
+    }
+
+    std::fprintf(stream, "%s%s%s\n", log_color(level), message, log_color_reset());
 }
 
 #define INTERNAL_LOG_BODY(_level)       \
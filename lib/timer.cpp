@@ -33,10 +33,24 @@
 
 #include <jsx/timer.h>
 
+#include <jsx/log.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
 namespace jsx {
 
 constexpr auto now = std::chrono::high_resolution_clock::now;
 
+/// Deadlines are kept on the steady clock so that adjustments to the system
+/// clock can neither trigger nor delay overrun reports.
+using SteadyClock = std::chrono::steady_clock;
+
 Timer::Timer(bool auto_start)
     : m_start(auto_start ? now() : Instant::min())
 {
@@ -79,4 +93,353 @@ ScopedTimer::~ScopedTimer()
     }
 }
 
+namespace detail {
+
+/// Lifecycle states of a deadline registration.
+enum class DeadlineState {
+    /// The scope is running and has not exceeded its budget.
+    Pending,
+
+    /// The watchdog is reporting the overrun.
+    Reporting,
+
+    /// The scope ended while the watchdog was reporting the overrun; the
+    /// watchdog will report the final duration once it is done.
+    FinishedWhileReporting,
+
+    /// The overrun has been reported.
+    Overrun,
+
+    /// The scope has ended.
+    Finished,
+};
+
+/// Registration shared between a deadline timer and the watchdog.
+///
+/// Each registration is owned by both the timer and the watchdog; whichever
+/// releases it last returns it to the entry pool.
+struct DeadlineEntry {
+    Timer timer { false };
+    SteadyClock::time_point deadline;
+    uint64_t budget_ms = 0;
+    uint64_t finished_ms = 0;
+    char const *name = nullptr;
+    std::function<void(DeadlineEvent, uint64_t)> on_event;
+
+    std::atomic<DeadlineState> state { DeadlineState::Pending };
+    std::atomic<int> references { 0 };
+    DeadlineEntry *next = nullptr;
+
+    void report(DeadlineEvent event, uint64_t elapsed) const
+    {
+        if (on_event) {
+            on_event(event, elapsed);
+            return;
+        }
+
+        auto display_name = name ? name : "<unnamed>";
+        if (event == DeadlineEvent::Overrun)
+            log_warn("Scope '%s' has exceeded its %llu ms budget (%llu ms elapsed).",
+                display_name, static_cast<unsigned long long>(budget_ms),
+                static_cast<unsigned long long>(elapsed));
+        else
+            log_warn("Scope '%s' finished in %llu ms, over its %llu ms budget.",
+                display_name, static_cast<unsigned long long>(elapsed),
+                static_cast<unsigned long long>(budget_ms));
+    }
+
+    void release();
+};
+
+/// Pool of recycled deadline entries.
+///
+/// Released entries are pushed onto a shared lock-free stack. Each thread
+/// takes the entire stack at once into a private cache and allocates from
+/// there, so popping never races with other threads. Entries are only ever
+/// heap-allocated when both are empty, i.e. the pool grows to the highest
+/// number of registrations alive at once plus those made within one watchdog
+/// check interval, as finished entries are only released by the watchdog once
+/// it has seen them.
+class DeadlineEntryPool {
+    static std::atomic<DeadlineEntry *> s_released;
+
+    DeadlineEntry *m_cache = nullptr;
+
+    static void push_released(DeadlineEntry *first, DeadlineEntry *last)
+    {
+        last->next = s_released.load(std::memory_order_relaxed);
+        while (!s_released.compare_exchange_weak(last->next, first,
+            std::memory_order_release, std::memory_order_relaxed))
+            ;
+    }
+
+public:
+    ~DeadlineEntryPool()
+    {
+        if (!m_cache)
+            return;
+
+        // Hand any cached entries back to the shared stack on thread exit.
+        auto last = m_cache;
+        while (last->next)
+            last = last->next;
+
+        push_released(m_cache, last);
+    }
+
+    /// Get the calling thread's pool.
+    static DeadlineEntryPool &local()
+    {
+        static thread_local DeadlineEntryPool pool;
+        return pool;
+    }
+
+    /// Take an entry from the pool, allocating a new one if it is empty.
+    DeadlineEntry *acquire()
+    {
+        if (!m_cache)
+            m_cache = s_released.exchange(nullptr, std::memory_order_acquire);
+        if (!m_cache)
+            return new DeadlineEntry;
+
+        auto entry = m_cache;
+        m_cache = entry->next;
+        return entry;
+    }
+
+    /// Return \p entry to the pool; safe to call from any thread.
+    static void recycle(DeadlineEntry *entry)
+    {
+        entry->on_event = nullptr;
+        push_released(entry, entry);
+    }
+};
+
+std::atomic<DeadlineEntry *> DeadlineEntryPool::s_released { nullptr };
+
+void DeadlineEntry::release()
+{
+    if (references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        DeadlineEntryPool::recycle(this);
+}
+
+/// Background thread which reports scopes that have exceeded their budget.
+///
+/// New registrations are pushed onto a lock-free stack by the timers and
+/// moved into a deadline-ordered heap by the watchdog thread, which is the
+/// only thread to ever touch the heap.
+class DeadlineWatchdog {
+    /// Upper bound on how long the watchdog sleeps between checks while it
+    /// has registrations to monitor.
+    static constexpr auto RESOLUTION = std::chrono::milliseconds(2);
+
+    /// Upper bound on how long the watchdog sleeps while idle; only matters if
+    /// a wakeup is lost, as `watch` notifies without taking the lock.
+    static constexpr auto IDLE_TIMEOUT = std::chrono::seconds(1);
+
+    struct LaterDeadline {
+        bool operator()(DeadlineEntry const *a, DeadlineEntry const *b) const
+        {
+            return a->deadline > b->deadline;
+        }
+    };
+
+    std::atomic<DeadlineEntry *> m_incoming { nullptr };
+    std::priority_queue<DeadlineEntry *, std::vector<DeadlineEntry *>, LaterDeadline> m_pending;
+
+    std::atomic<bool> m_stopping { false };
+    std::atomic<bool> m_idle { false };
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::thread m_thread;
+
+    /// Move all newly-registered entries into the pending heap, dropping any
+    /// which have already finished.
+    void drain_incoming()
+    {
+        auto entry = m_incoming.exchange(nullptr, std::memory_order_acquire);
+        while (entry) {
+            auto next = entry->next;
+            if (entry->state.load(std::memory_order_acquire) == DeadlineState::Finished)
+                entry->release();
+            else
+                m_pending.push(entry);
+
+            entry = next;
+        }
+    }
+
+    /// Report the overrun of \p entry, unless it has already finished.
+    static void report_overrun(DeadlineEntry *entry)
+    {
+        auto expected = DeadlineState::Pending;
+        if (!entry->state.compare_exchange_strong(expected, DeadlineState::Reporting,
+                std::memory_order_acq_rel))
+            return;
+
+        entry->report(DeadlineEvent::Overrun, entry->timer.elapsed_ms());
+
+        // If the scope ended while the overrun was being reported, its owner
+        // has already moved on and left the final report to the watchdog.
+        expected = DeadlineState::Reporting;
+        if (!entry->state.compare_exchange_strong(expected, DeadlineState::Overrun,
+                std::memory_order_acq_rel))
+            entry->report(DeadlineEvent::Finished, entry->finished_ms);
+    }
+
+    /// Report and retire all pending entries whose deadline has passed, as
+    /// well as finished entries at the front of the heap, so that the
+    /// watchdog goes idle as soon as every scope has ended.
+    void check_deadlines(SteadyClock::time_point current)
+    {
+        while (!m_pending.empty()) {
+            auto entry = m_pending.top();
+            if (entry->deadline > current
+                && entry->state.load(std::memory_order_acquire) != DeadlineState::Finished)
+                break;
+
+            m_pending.pop();
+
+            report_overrun(entry);
+            entry->release();
+        }
+    }
+
+    void run()
+    {
+        while (!m_stopping.load(std::memory_order_acquire)) {
+            drain_incoming();
+            check_deadlines(SteadyClock::now());
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            // With nothing to monitor, sleep until a registration arrives;
+            // `watch` only wakes the watchdog while it is idle.
+            if (m_pending.empty()) {
+                m_idle.store(true);
+                m_wakeup.wait_for(lock, IDLE_TIMEOUT, [this] {
+                    return m_stopping.load() || m_incoming.load() != nullptr;
+                });
+                m_idle.store(false);
+                continue;
+            }
+
+            auto wake_time = std::min(m_pending.top()->deadline,
+                SteadyClock::now() + RESOLUTION);
+            m_wakeup.wait_until(lock, wake_time, [this] {
+                return m_stopping.load(std::memory_order_acquire);
+            });
+        }
+    }
+
+public:
+    DeadlineWatchdog()
+        : m_thread(&DeadlineWatchdog::run, this)
+    {
+    }
+
+    ~DeadlineWatchdog()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping.store(true);
+        }
+        m_wakeup.notify_one();
+        m_thread.join();
+
+        drain_incoming();
+        for (; !m_pending.empty(); m_pending.pop())
+            m_pending.top()->release();
+    }
+
+    /// Get the shared watchdog, starting it if necessary.
+    static DeadlineWatchdog &shared()
+    {
+        static DeadlineWatchdog watchdog;
+        return watchdog;
+    }
+
+    /// Hand \p entry over to the watchdog for monitoring.
+    void watch(DeadlineEntry *entry)
+    {
+        entry->next = m_incoming.load(std::memory_order_relaxed);
+        while (!m_incoming.compare_exchange_weak(entry->next, entry))
+            ;
+
+        // Only an idle watchdog needs waking; a busy one will pick the entry
+        // up on its next check. The lock is deliberately not taken here, so a
+        // notification racing with the watchdog going to sleep can be lost;
+        // the idle timeout bounds the resulting delay.
+        if (!entry->next && m_idle.load())
+            m_wakeup.notify_one();
+    }
+};
+
+}
+
+static detail::DeadlineEntry *create_deadline_entry(char const *name,
+    uint64_t budget_ms, std::function<void(DeadlineEvent, uint64_t)> on_event,
+    Timer const &timer)
+{
+    auto entry = detail::DeadlineEntryPool::local().acquire();
+    entry->timer = timer;
+    // Clamp the budget so that huge values (e.g. UINT64_MAX as "no limit")
+    // neither wrap negative nor overflow the deadline.
+    constexpr auto max_budget_ms = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(SteadyClock::duration::max())
+            .count()
+        / 2);
+    budget_ms = std::min(budget_ms, max_budget_ms);
+
+    entry->deadline = SteadyClock::now() + std::chrono::milliseconds(budget_ms);
+    entry->budget_ms = budget_ms;
+    entry->name = name;
+    entry->on_event = std::move(on_event);
+    entry->state.store(detail::DeadlineState::Pending, std::memory_order_relaxed);
+    entry->references.store(2, std::memory_order_relaxed);
+
+    detail::DeadlineWatchdog::shared().watch(entry);
+    return entry;
+}
+
+DeadlineTimer::DeadlineTimer(char const *name, uint64_t budget_ms)
+    : m_entry(create_deadline_entry(name, budget_ms, nullptr, *this))
+{
+}
+
+DeadlineTimer::DeadlineTimer(uint64_t budget_ms, DeadlineCallbackMs on_event)
+    : m_entry(create_deadline_entry(nullptr, budget_ms, std::move(on_event), *this))
+{
+}
+
+DeadlineTimer::~DeadlineTimer()
+{
+    using detail::DeadlineState;
+
+    auto expected = DeadlineState::Pending;
+    if (m_entry->state.compare_exchange_strong(expected, DeadlineState::Finished,
+            std::memory_order_acq_rel)) {
+        // The watchdog only checks periodically, so a scope can overrun and
+        // end before it is noticed; still report the final duration then.
+        if (auto elapsed = elapsed_ms(); elapsed > m_entry->budget_ms)
+            m_entry->report(DeadlineEvent::Finished, elapsed);
+    } else {
+        auto elapsed = elapsed_ms();
+
+        // Never wait on the watchdog: if it is still reporting the overrun,
+        // leave the final report to it.
+        m_entry->finished_ms = elapsed;
+        if (expected == DeadlineState::Reporting
+            && m_entry->state.compare_exchange_strong(expected,
+                DeadlineState::FinishedWhileReporting, std::memory_order_acq_rel)) {
+            m_entry->release();
+            return;
+        }
+
+        m_entry->report(DeadlineEvent::Finished, elapsed);
+    }
+
+    m_entry->release();
+}
+
 }
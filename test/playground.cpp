@@ -1,3 +1,4 @@
+#include <jsx/alloc.h>
 #include <jsx/hex.h>
 #include <jsx/log.h>
 #include <jsx/timer.h>
@@ -48,14 +49,30 @@ int main(int argc, char **argv)
         std::this_thread::sleep_for(std::chrono::milliseconds(7));
     }
 
+    {
+        jsx::DeadlineTimer deadline_timer("playground", 5);
+        std::this_thread::sleep_for(std::chrono::milliseconds(12));
+    }
+
     auto hex_string = hex_encode({ 'A', 'A', 'A', 'A' });
     jsx::log_info("Printing \"AAAA\" in hex: %s", hex_string.c_str());
 
-    auto dump = jsx::hex_format_dump(dump_data, sizeof(dump_data), 0x1000);
+    std::string dump;
+    {
+        jsx::ScopedAllocTracker dump_tracker([](AllocStats const &stats, uint64_t ms) {
+            jsx::log_info("Hex dump formatted in %llu ms with %llu allocations (%llu bytes, peak %llu bytes).",
+                static_cast<unsigned long long>(ms),
+                static_cast<unsigned long long>(stats.allocations),
+                static_cast<unsigned long long>(stats.bytes),
+                static_cast<unsigned long long>(stats.peak_bytes));
+        });
+
+        dump = jsx::hex_format_dump(dump_data, sizeof(dump_data), 0x1000);
+    }
     jsx::log_debug("%s", dump.c_str());
 
     std::this_thread::sleep_for(std::chrono::milliseconds(34));
-    jsx::log_info("All functionality tested in %llu ms. (Expected: ~41 ms.)", clock.elapsed_ms());
+    jsx::log_info("All functionality tested in %llu ms. (Expected: ~53 ms.)", clock.elapsed_ms());
     jsx::log_info("Info and debug messages logged in %llu ms. (Expected: ~7 ms.)", log_time);
 
     return 0;